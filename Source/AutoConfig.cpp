@@ -0,0 +1,370 @@
+/*
+  ==============================================================================
+
+    Offline analysis that proposes crossover, threshold and ratio settings
+    for a whole program (a track or an album) ahead of time.
+
+  ==============================================================================
+*/
+
+#include "AutoConfig.h"
+#include "Crossover.h"
+#include "PluginProcessor.h"
+
+#include <future>
+
+namespace
+{
+using Filter=juce::dsp::LinkwitzRileyFilter<float>;
+
+constexpr int subBlockSize=4096;
+constexpr double preRollSeconds=.5;     // lets each chunk's filters settle before it is measured
+constexpr double levelWindowSeconds=.01;
+
+constexpr size_t numCandidates=8;       // per crossover
+
+constexpr float histogramFloorDb=-96.f;
+constexpr float histogramStepDb=.5f;
+constexpr size_t histogramBins=240;     // -96 dB to +24 dB
+using Histogram=std::array<juce::uint64,histogramBins>;
+
+struct ProgramInfo
+{
+    double sampleRate;
+    int numChannels;
+    juce::int64 length;
+};
+
+struct Chunk
+{
+    juce::int64 start;      // first sample that counts towards the result
+    juce::int64 preRoll;    // samples processed before start and thrown away
+    juce::int64 length;
+};
+
+// Runs analyseChunk over one slice of the program per core and returns the per-chunk results.
+// Each chunk gets its own reader and its own filters, so nothing is shared between them.
+template<typename AnalyseChunk>
+auto analyseInParallel(const AutoConfig::ReaderFactory& makeReader, const ProgramInfo& program, AnalyseChunk analyseChunk)
+{
+    using Result=decltype(analyseChunk(std::declval<juce::AudioFormatReader&>(), Chunk{}));
+    
+    auto numChunks=static_cast<juce::int64>(juce::jmax(1, juce::SystemStats::getNumCpus()));
+    auto chunkLength=juce::jmax(static_cast<juce::int64>(1), (program.length+numChunks-1)/numChunks);
+    auto preRoll=static_cast<juce::int64>(program.sampleRate*preRollSeconds);
+    
+    std::vector<std::future<Result>> futures;
+    for (juce::int64 start=0;start<program.length;start+=chunkLength){
+        auto chunk=Chunk { start, juce::jmin(preRoll, start), juce::jmin(chunkLength, program.length-start) };
+        futures.push_back(std::async(std::launch::async, [&makeReader, &analyseChunk, chunk]{
+            auto reader=makeReader();
+            return reader!=nullptr ? analyseChunk(*reader, chunk) : Result {};
+        }));
+    }
+    
+    std::vector<Result> results;
+    for (auto& future:futures){
+        results.push_back(future.get());
+    }
+    return results;
+}
+
+// Streams a chunk from its reader in sub-blocks, so memory stays small however long the
+// program is. process(block, firstCountedSample) sees every sub-block, pre-roll included.
+template<typename Process>
+void forEachSubBlock(juce::AudioFormatReader& reader, const ProgramInfo& program, const Chunk& chunk,
+                     const std::atomic<bool>* cancelled, Process process)
+{
+    juce::AudioBuffer<float> work(program.numChannels, subBlockSize);
+    
+    auto end=chunk.start+chunk.length;
+    for (auto pos=chunk.start-chunk.preRoll;pos<end;pos+=subBlockSize){
+        if (cancelled!=nullptr && cancelled->load()){
+            return;
+        }
+        
+        auto numSamples=static_cast<int>(juce::jmin(static_cast<juce::int64>(subBlockSize), end-pos));
+        reader.read(&work, 0, numSamples, pos, true, true);
+        
+        auto block=juce::dsp::AudioBlock<float>(work).getSubBlock(0, static_cast<size_t>(numSamples));
+        process(block, static_cast<int>(juce::jmax(static_cast<juce::int64>(0), chunk.start-pos)));
+    }
+}
+
+double sumOfSquares(const juce::dsp::AudioBlock<float>& block, int from)
+{
+    double sum=0;
+    for (size_t ch=0;ch<block.getNumChannels();++ch){
+        auto* data=block.getChannelPointer(ch);
+        for (auto i=static_cast<size_t>(from);i<block.getNumSamples();++i){
+            sum+=static_cast<double>(data[i])*data[i];
+        }
+    }
+    return sum;
+}
+
+std::array<float,numCandidates> candidatesFor(Params::Names name)
+{
+    const auto& spec=Params::specFor(name);
+    std::array<float,numCandidates> candidates;
+    for (size_t i=0;i<numCandidates;++i){
+        auto proportion=static_cast<float>(i)/(numCandidates-1);
+        candidates[i]=spec.start*std::pow(spec.end/spec.start, proportion);
+    }
+    return candidates;
+}
+
+// Frequency (interpolated in log-frequency) where the energy below first reaches the given share.
+float frequencyForShare(const std::array<float,numCandidates>& candidates, const std::array<double,numCandidates>& shareBelow, float share)
+{
+    if (share<=shareBelow.front()){
+        return candidates.front();
+    }
+    for (size_t i=1;i<numCandidates;++i){
+        if (share<=shareBelow[i]){
+            auto span=shareBelow[i]-shareBelow[i-1];
+            auto proportion=span>0 ? static_cast<float>((share-shareBelow[i-1])/span) : 0.f;
+            return candidates[i-1]*std::pow(candidates[i]/candidates[i-1], proportion);
+        }
+    }
+    return candidates.back();
+}
+
+float levelAtPercentile(const Histogram& histogram, size_t firstBin, juce::uint64 count, float percentile)
+{
+    auto wanted=static_cast<juce::uint64>(std::ceil(percentile*static_cast<float>(count)));
+    juce::uint64 seen=0;
+    for (auto bin=firstBin;bin<histogramBins;++bin){
+        seen+=histogram[bin];
+        if (seen>=wanted){
+            return histogramFloorDb+(static_cast<float>(bin)+.5f)*histogramStepDb;
+        }
+    }
+    return histogramFloorDb+histogramBins*histogramStepDb;
+}
+
+int nearestRatioIndex(float ratio)
+{
+    auto best=0;
+    for (size_t i=1;i<Params::RatioChoices.size();++i){
+        if (std::abs(std::log(Params::RatioChoices[i]/ratio))<std::abs(std::log(Params::RatioChoices[static_cast<size_t>(best)]/ratio))){
+            best=static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+float clampToParameter(Params::Names name, float value)
+{
+    const auto& spec=Params::specFor(name);
+    auto snapped=spec.interval>0 ? std::round(value/spec.interval)*spec.interval : value;
+    return juce::jlimit(spec.start, spec.end, snapped);
+}
+}
+
+namespace AutoConfig
+{
+std::optional<Proposal> analyse(const ReaderFactory& makeReader, const Target& target, const std::atomic<bool>* cancelled)
+{
+    using namespace Params;
+    
+    ProgramInfo program;
+    if (auto reader=makeReader()){
+        program={ reader->sampleRate, static_cast<int>(reader->numChannels), reader->lengthInSamples };
+    }
+    else{
+        return {};
+    }
+    
+    if (program.sampleRate<=0 || program.numChannels<=0){
+        return {};
+    }
+    
+    Proposal proposal;
+    
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate=program.sampleRate;
+    spec.maximumBlockSize=subBlockSize;
+    spec.numChannels=static_cast<juce::uint32>(program.numChannels);
+    
+    // Pass 1: energy below each candidate frequency, to place the crossovers.
+    const auto lowMidCandidates=candidatesFor(Names::Low_Mid_Crossover_Freq);
+    const auto midHighCandidates=candidatesFor(Names::Mid_High_Crossover_Freq);
+    
+    struct Energy
+    {
+        double total=0;
+        std::array<double,numCandidates> belowLowMid {}, belowMidHigh {};
+    };
+    
+    auto energies=analyseInParallel(makeReader, program, [&](juce::AudioFormatReader& reader, const Chunk& chunk){
+        Energy energy;
+        std::array<Filter,numCandidates> lowMid, midHigh;
+        for (size_t i=0;i<numCandidates;++i){
+            for (auto* filter : { &lowMid[i], &midHigh[i] }){
+                filter->setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+                filter->prepare(spec);
+            }
+            lowMid[i].setCutoffFrequency(lowMidCandidates[i]);
+            midHigh[i].setCutoffFrequency(midHighCandidates[i]);
+        }
+        
+        juce::AudioBuffer<float> filtered(program.numChannels, subBlockSize);
+        forEachSubBlock(reader, program, chunk, cancelled, [&](juce::dsp::AudioBlock<float>& block, int from){
+            energy.total+=sumOfSquares(block, from);
+            
+            auto measureBelow=[&](Filter& filter, double& below){
+                auto out=juce::dsp::AudioBlock<float>(filtered).getSubBlock(0, block.getNumSamples());
+                filter.process(juce::dsp::ProcessContextNonReplacing<float>(block, out));
+                below+=sumOfSquares(out, from);
+            };
+            
+            for (size_t i=0;i<numCandidates;++i){
+                measureBelow(lowMid[i], energy.belowLowMid[i]);
+                measureBelow(midHigh[i], energy.belowMidHigh[i]);
+            }
+        });
+        return energy;
+    });
+    
+    if (cancelled!=nullptr && cancelled->load()){
+        return {};
+    }
+    
+    Energy energy;
+    for (const auto& e:energies){
+        energy.total+=e.total;
+        for (size_t i=0;i<numCandidates;++i){
+            energy.belowLowMid[i]+=e.belowLowMid[i];
+            energy.belowMidHigh[i]+=e.belowMidHigh[i];
+        }
+    }
+    
+    if (energy.total>0){
+        for (size_t i=0;i<numCandidates;++i){
+            energy.belowLowMid[i]/=energy.total;
+            energy.belowMidHigh[i]/=energy.total;
+        }
+        
+        auto shareBelowMidHigh=target.energyShare[0]+target.energyShare[1];
+        proposal.lowMidCrossover=frequencyForShare(lowMidCandidates, energy.belowLowMid, target.energyShare[0]);
+        proposal.midHighCrossover=frequencyForShare(midHighCandidates, energy.belowMidHigh, shareBelowMidHigh);
+    }
+    
+    proposal.lowMidCrossover=clampToParameter(Names::Low_Mid_Crossover_Freq, proposal.lowMidCrossover);
+    proposal.midHighCrossover=clampToParameter(Names::Mid_High_Crossover_Freq, proposal.midHighCrossover);
+    
+    // Pass 2: split at the proposed crossovers with the processor's own crossover, and build
+    // a histogram of short-term levels for each band.
+    auto windowLength=juce::jmax(1, juce::roundToInt(program.sampleRate*levelWindowSeconds));
+    
+    auto histograms=analyseInParallel(makeReader, program, [&](juce::AudioFormatReader& reader, const Chunk& chunk){
+        std::array<Histogram,3> bandHistograms {};
+        
+        ThreeBandCrossover<float> crossover;
+        crossover.prepare(spec);
+        crossover.setCrossovers(proposal.lowMidCrossover, proposal.midHighCrossover);
+        
+        std::array<juce::AudioBuffer<float>,2> scratch;
+        for (auto& buffer:scratch){
+            buffer.setSize(program.numChannels, subBlockSize);
+        }
+        
+        std::array<double,3> windowSums {};
+        auto windowFill=0;
+        auto numChannels=static_cast<double>(program.numChannels);
+        
+        forEachSubBlock(reader, program, chunk, cancelled, [&](juce::dsp::AudioBlock<float>& block, int from){
+            auto numSamples=block.getNumSamples();
+            auto lowBand=juce::dsp::AudioBlock<float>(scratch[0]).getSubBlock(0, numSamples);
+            auto midBand=juce::dsp::AudioBlock<float>(scratch[1]).getSubBlock(0, numSamples);
+            auto& highBand=block;
+            
+            crossover.process(block, lowBand, midBand, highBand);
+            
+            const std::array<const juce::dsp::AudioBlock<float>*,3> bands { &lowBand, &midBand, &highBand };
+            
+            for (auto i=static_cast<size_t>(from);i<numSamples;++i){
+                for (size_t b=0;b<bands.size();++b){
+                    for (size_t ch=0;ch<bands[b]->getNumChannels();++ch){
+                        auto sample=static_cast<double>(bands[b]->getSample(static_cast<int>(ch), static_cast<int>(i)));
+                        windowSums[b]+=sample*sample;
+                    }
+                }
+                
+                if (++windowFill==windowLength){
+                    for (size_t b=0;b<bands.size();++b){
+                        auto meanSquare=windowSums[b]/(windowLength*numChannels);
+                        auto levelDb=juce::Decibels::gainToDecibels(static_cast<float>(std::sqrt(meanSquare)), -200.f);
+                        auto bin=juce::jlimit(0, static_cast<int>(histogramBins)-1, static_cast<int>((levelDb-histogramFloorDb)/histogramStepDb));
+                        ++bandHistograms[b][static_cast<size_t>(bin)];
+                        windowSums[b]=0;
+                    }
+                    windowFill=0;
+                }
+            }
+        });
+        return bandHistograms;
+    });
+    
+    if (cancelled!=nullptr && cancelled->load()){
+        return {};
+    }
+    
+    // Pick each band's threshold from its level distribution, then the ratio that takes the
+    // loud end of the distribution down by the target amount.
+    jassert(target.maxRatio>1.f);
+    auto firstAudibleBin=static_cast<size_t>(juce::jmax(0.f, (target.silenceDb-histogramFloorDb)/histogramStepDb));
+    
+    for (size_t b=0;b<Bands.size();++b){
+        Histogram histogram {};
+        for (const auto& chunkHistograms:histograms){
+            for (size_t bin=0;bin<histogramBins;++bin){
+                histogram[bin]+=chunkHistograms[b][bin];
+            }
+        }
+        
+        juce::uint64 count=0;
+        for (auto bin=firstAudibleBin;bin<histogramBins;++bin){
+            count+=histogram[bin];
+        }
+        
+        const auto& names=Bands[b];
+        if (count==0){
+            proposal.thresholds[b]=specFor(names.threshold).defaultValue;
+            proposal.ratioIndices[b]=static_cast<int>(specFor(names.ratio).defaultValue);
+            continue;
+        }
+        
+        auto threshold=levelAtPercentile(histogram, firstAudibleBin, count, target.thresholdPercentile);
+        auto loud=levelAtPercentile(histogram, firstAudibleBin, count, target.loudPercentile);
+        auto reduction=target.gainReductionDb[b];
+        
+        // Above threshold the compressor removes (level - threshold) * (1 - 1/ratio) dB, so at
+        // maxRatio the loud passages have to sit at least this far over the threshold. Dense,
+        // already mastered material often doesn't; lower the threshold rather than proposing
+        // a limiter's ratio that still wouldn't reach the target.
+        auto minOvershoot=reduction*target.maxRatio/(target.maxRatio-1.f);
+        threshold=clampToParameter(names.threshold, juce::jmin(threshold, loud-minOvershoot));
+        
+        auto overshoot=loud-threshold;
+        auto ratio=overshoot>reduction ? juce::jmin(target.maxRatio, overshoot/(overshoot-reduction)) : target.maxRatio;
+        
+        proposal.thresholds[b]=threshold;
+        proposal.ratioIndices[b]=nearestRatioIndex(ratio);
+    }
+    
+    return proposal;
+}
+
+std::optional<Proposal> analyse(const juce::File& file, const Target& target, const std::atomic<bool>* cancelled)
+{
+    auto makeReader=[file]{
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        return std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(file));
+    };
+    
+    return analyse(makeReader, target, cancelled);
+}
+}
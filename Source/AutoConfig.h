@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    Offline analysis that proposes crossover, threshold and ratio settings
+    for a whole program (a track or an album) ahead of time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <functional>
+#include <optional>
+
+namespace AutoConfig
+{
+// What the proposal should aim for. Bands are ordered low to high.
+struct Target
+{
+    // Share of the program's energy each band should carry; picks the crossovers.
+    std::array<float,3> energyShare { .5f, .4f, .1f };
+
+    // Gain reduction each band should reach on its loud passages.
+    std::array<float,3> gainReductionDb { 4.f, 3.f, 2.f };
+    
+    // Highest ratio a proposal may use. When the loud passages sit too close to the
+    // threshold to reach the target below this, the threshold is lowered instead.
+    float maxRatio { 4.f };
+
+    // Where in a band's level distribution the threshold sits, and what counts as loud.
+    float thresholdPercentile { .5f };
+    float loudPercentile { .95f };
+
+    // Windows quieter than this are treated as silence and left out of the distributions.
+    float silenceDb { -70.f };
+};
+
+// Thresholds are levels in the program as read, before the processor's input gain.
+struct Proposal
+{
+    float lowMidCrossover { 400.f };
+    float midHighCrossover { 2000.f };
+    std::array<float,3> thresholds {};
+    std::array<int,3> ratioIndices {};
+};
+
+// Must hand out a fresh, independent reader for the same program every time it is called,
+// from several threads at once: each chunk of the analysis streams its own range through
+// its own reader, so the program never has to be decoded into memory as a whole.
+using ReaderFactory=std::function<std::unique_ptr<juce::AudioFormatReader>()>;
+
+// Scans the whole program in one chunk per core and blocks until every chunk is done.
+// Not for the audio thread. Returns nothing if the program can't be read, or if
+// cancelled is set while the analysis runs.
+std::optional<Proposal> analyse(const ReaderFactory& makeReader, const Target& target={}, const std::atomic<bool>* cancelled=nullptr);
+
+// Same, for any audio file format JUCE can read out of the box.
+std::optional<Proposal> analyse(const juce::File& file, const Target& target={}, const std::atomic<bool>* cancelled=nullptr);
+}
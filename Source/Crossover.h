@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    The Linkwitz-Riley three-band split, shared by the processor and the
+    offline analysis so the two always split the same way.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+  Splits a signal into three bands that sum back to an allpassed copy of it:
+
+          FC0    FC1
+    low   LP1 -> AP2
+    mid   HP1 -> LP2
+    high  HP1 -> HP2
+
+  SampleType is the precision the filters compute and keep their state in; the audio
+  going in and out is always float.
+ */
+template<typename SampleType>
+class ThreeBandCrossover
+{
+public:
+    ThreeBandCrossover(){
+        LP1.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        HP1.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+
+        AP2.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+
+        LP2.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        HP2.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec){
+        for (auto* filter:filters()){
+            filter->prepare(spec);
+        }
+    }
+
+    void reset(){
+        for (auto* filter:filters()){
+            filter->reset();
+        }
+    }
+
+    void setCrossovers(float lowMidFreq, float midHighFreq){
+        LP1.setCutoffFrequency(static_cast<SampleType>(lowMidFreq));
+        HP1.setCutoffFrequency(static_cast<SampleType>(lowMidFreq));
+
+        AP2.setCutoffFrequency(static_cast<SampleType>(midHighFreq));
+        LP2.setCutoffFrequency(static_cast<SampleType>(midHighFreq));
+        HP2.setCutoffFrequency(static_cast<SampleType>(midHighFreq));
+    }
+
+    // Each input sample is read before anything is written at its position, so an output
+    // may share memory with the input (the processor splits its high band in place).
+    void process(const juce::dsp::AudioBlock<const float>& input,
+                 juce::dsp::AudioBlock<float> low,
+                 juce::dsp::AudioBlock<float> mid,
+                 juce::dsp::AudioBlock<float> high) noexcept
+    {
+        auto numChannels=input.getNumChannels();
+        auto numSamples=input.getNumSamples();
+        jassert(low.getNumChannels()==numChannels && mid.getNumChannels()==numChannels && high.getNumChannels()==numChannels);
+        jassert(low.getNumSamples()==numSamples && mid.getNumSamples()==numSamples && high.getNumSamples()==numSamples);
+
+        for (size_t ch=0;ch<numChannels;++ch){
+            auto channel=static_cast<int>(ch);
+            const auto* in=input.getChannelPointer(ch);
+            auto* lowOut=low.getChannelPointer(ch);
+            auto* midOut=mid.getChannelPointer(ch);
+            auto* highOut=high.getChannelPointer(ch);
+
+            for (size_t i=0;i<numSamples;++i){
+                auto x=static_cast<SampleType>(in[i]);
+                auto upper=HP1.processSample(channel, x);
+
+                lowOut[i]=static_cast<float>(AP2.processSample(channel, LP1.processSample(channel, x)));
+                midOut[i]=static_cast<float>(LP2.processSample(channel, upper));
+                highOut[i]=static_cast<float>(HP2.processSample(channel, upper));
+            }
+        }
+
+       #if JUCE_DSP_ENABLE_SNAP_TO_ZERO
+        for (auto* filter:filters()){
+            filter->snapToZero();
+        }
+       #endif
+    }
+
+private:
+    using Filter=juce::dsp::LinkwitzRileyFilter<SampleType>;
+    //     FC0  FC1
+    Filter LP1, AP2,
+           HP1, LP2,
+                HP2;
+
+    std::array<Filter*,5> filters(){
+        return { &LP1, &AP2, &HP1, &LP2, &HP2 };
+    }
+};
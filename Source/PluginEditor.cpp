@@ -9,13 +9,44 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+constexpr int buttonRowHeight=40;
+const juce::String autoConfigureText { "Auto-configure from file..." };
+}
+
 //==============================================================================
 FirstCompressorAudioProcessorEditor::FirstCompressorAudioProcessorEditor (FirstCompressorAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), parameterEditor (p)
 {
+    addAndMakeVisible(parameterEditor);
+    
+    autoConfigureButton.setButtonText(autoConfigureText);
+    autoConfigureButton.onClick=[this]{ chooseFileToAnalyse(); };
+    addAndMakeVisible(autoConfigureButton);
+    
+    const AutoConfig::Target defaults;
+    const std::array<juce::String,3> bandNames { "Low", "Mid", "High" };
+    for (size_t i=0;i<targetReductionSliders.size();++i){
+        auto& slider=targetReductionSliders[i];
+        slider.setSliderStyle(juce::Slider::LinearBar);
+        slider.setRange(0, 12, .5);
+        slider.setValue(defaults.gainReductionDb[i], juce::dontSendNotification);
+        slider.textFromValueFunction=[name=bandNames[i]](double value){
+            return name+" target GR "+juce::String(value,1)+" dB";
+        };
+        slider.setTextBoxIsEditable(false);   // dragged only; the label text wouldn't parse back
+        slider.updateText();
+        addAndMakeVisible(slider);
+    }
+    
+    // The analysis runs in the background; keep the button in step with it.
+    startTimerHz(4);
+    timerCallback();
+    
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (parameterEditor.getWidth(), parameterEditor.getHeight()+buttonRowHeight);
 }
 
 FirstCompressorAudioProcessorEditor::~FirstCompressorAudioProcessorEditor()
@@ -27,14 +58,50 @@ void FirstCompressorAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
 void FirstCompressorAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto bounds=getLocalBounds();
+    auto buttonRow=bounds.removeFromBottom(buttonRowHeight).reduced(8);
+    parameterEditor.setBounds(bounds);
+    
+    autoConfigureButton.setBounds(buttonRow.removeFromLeft(buttonRow.getWidth()/3).reduced(2, 0));
+    auto sliderWidth=buttonRow.getWidth()/static_cast<int>(targetReductionSliders.size());
+    for (auto& slider:targetReductionSliders){
+        slider.setBounds(buttonRow.removeFromLeft(sliderWidth).reduced(2, 0));
+    }
+}
+
+void FirstCompressorAudioProcessorEditor::timerCallback()
+{
+    auto analysing=audioProcessor.isAutoConfiguring();
+    autoConfigureButton.setEnabled(! analysing);
+    for (auto& slider:targetReductionSliders){
+        slider.setEnabled(! analysing);
+    }
+    autoConfigureButton.setButtonText(analysing ? juce::String("Analysing...") : autoConfigureText);
+}
+
+void FirstCompressorAudioProcessorEditor::chooseFileToAnalyse()
+{
+    // AudioFormatManager starts empty, so build the wildcard from one with the formats registered.
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    fileChooser=std::make_unique<juce::FileChooser>("Choose a track or album to analyse",
+                                                    juce::File(),
+                                                    formats.getWildcardForAllFormats());
+    
+    fileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                             [this](const juce::FileChooser& chooser){
+        auto file=chooser.getResult();
+        if (file.existsAsFile()){
+            AutoConfig::Target target;
+            for (size_t i=0;i<targetReductionSliders.size();++i){
+                target.gainReductionDb[i]=static_cast<float>(targetReductionSliders[i].getValue());
+            }
+            audioProcessor.startAutoConfigure(file, target);
+            timerCallback();
+        }
+    });
 }
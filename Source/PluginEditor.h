@@ -14,7 +14,8 @@
 //==============================================================================
 /**
 */
-class FirstCompressorAudioProcessorEditor  : public juce::AudioProcessorEditor
+class FirstCompressorAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                             private juce::Timer
 {
 public:
     FirstCompressorAudioProcessorEditor (FirstCompressorAudioProcessor&);
@@ -25,9 +26,19 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+    void chooseFileToAnalyse();
+    
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     FirstCompressorAudioProcessor& audioProcessor;
+    
+    juce::GenericAudioProcessorEditor parameterEditor;
+    juce::TextButton autoConfigureButton;
+    
+    // Target gain reduction per band for the auto-configure proposal, low to high.
+    std::array<juce::Slider,3> targetReductionSliders;
+    std::unique_ptr<juce::FileChooser> fileChooser;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FirstCompressorAudioProcessorEditor)
 };
@@ -18,75 +18,49 @@ FirstCompressorAudioProcessor::FirstCompressorAudioProcessor()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       .withOutput ("Low Band", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Mid Band", juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("High Band", juce::AudioChannelSet::stereo(), false)
                      #endif
                        )
 #endif
 {
     using namespace Params;
-    const auto params=GetParams();
-    auto floathelper=[&apvts=this->apvts, &params](auto& param, const auto& paramName){
-        param=dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter(params.at(paramName)));
-        jassert(param!=nullptr);
+    const auto& bound=paramBindings;
+    
+    // The band index is a template argument so each band's names are known at compile time.
+    auto bindBand=[this, &bound](auto band){
+        constexpr auto names=Bands[decltype(band)::value];
+        auto& comp=compressors[decltype(band)::value];
+        
+        comp.attack=bound.get<names.attack>();
+        comp.release=bound.get<names.release>();
+        comp.threshold=bound.get<names.threshold>();
+        comp.ratio=bound.get<names.ratio>();
+        comp.bypassed=bound.get<names.bypassed>();
+        comp.mute=bound.get<names.mute>();
+        comp.solo=bound.get<names.solo>();
     };
     
-    // I wonder if all the repetition here can be avoided. (This looks dogshit, and won't scale to a dynamic number of bands)
-    floathelper(lowBandComp.attack, Names::Attack_Low_Band);
-    floathelper(lowBandComp.release, Names::Release_Low_Band);
-    floathelper(lowBandComp.threshold, Names::Threshold_Low_Band);
+    bindBand(std::integral_constant<size_t,0>{});
+    bindBand(std::integral_constant<size_t,1>{});
+    bindBand(std::integral_constant<size_t,2>{});
     
-    floathelper(midBandComp.attack, Names::Attack_Mid_Band);
-    floathelper(midBandComp.release, Names::Release_Mid_Band);
-    floathelper(midBandComp.threshold, Names::Threshold_Mid_Band);
-    
-    floathelper(highBandComp.attack, Names::Attack_High_Band);
-    floathelper(highBandComp.release, Names::Release_High_Band);
-    floathelper(highBandComp.threshold, Names::Threshold_High_Band);
-    
-    auto choicehelper=[&apvts=this->apvts, &params](auto& param, const auto& paramName){
-        param=dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter(params.at(paramName)));
-        jassert(param!=nullptr);
-    };
-    
-    choicehelper(lowBandComp.ratio, Names::Ratio_Low_Band);
-    choicehelper(midBandComp.ratio, Names::Ratio_Mid_Band);
-    choicehelper(highBandComp.ratio, Names::Ratio_High_Band);
-    
-    auto boolhelper=[&apvts=this->apvts, &params](auto& param, const auto& paramName){
-        param=dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter(params.at(paramName)));
-        jassert(param!=nullptr);
-    };
-    
-    boolhelper(lowBandComp.bypassed, Names::Bypassed_Low_Band);
-    boolhelper(midBandComp.bypassed, Names::Bypassed_Mid_Band);
-    boolhelper(highBandComp.bypassed, Names::Bypassed_High_Band);
-    
-    boolhelper(lowBandComp.mute, Names::Mute_Low_Band);
-    boolhelper(midBandComp.mute, Names::Mute_Mid_Band);
-    boolhelper(highBandComp.mute, Names::Mute_High_Band);
-    
-    boolhelper(lowBandComp.solo, Names::Solo_Low_Band);
-    boolhelper(midBandComp.solo, Names::Solo_Mid_Band);
-    boolhelper(highBandComp.solo, Names::Solo_High_Band);
-    
-    floathelper(lowMidCrossover, Names::Low_Mid_Crossover_Freq);
-    floathelper(midHighCrossover, Names::Mid_High_Crossover_Freq);
-    
-    floathelper(inputGainParam, Names::Gain_In);
-    floathelper(outputGainParam, Names::Gain_Out);
-    
-    LP1.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
-    HP1.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
-    
-    AP2.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
-    
-    LP2.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
-    HP2.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+    lowMidCrossover=bound.get<Names::Low_Mid_Crossover_Freq>();
+    midHighCrossover=bound.get<Names::Mid_High_Crossover_Freq>();
     
+    inputGainParam=bound.get<Names::Gain_In>();
+    outputGainParam=bound.get<Names::Gain_Out>();
     
 }
 
 FirstCompressorAudioProcessor::~FirstCompressorAudioProcessor()
 {
+    // The analysis reads this object's cancel flag, so it has to stop before we go.
+    autoConfigCancelled=true;
+    if (autoConfigTask.valid()){
+        autoConfigTask.wait();
+    }
 }
 
 //==============================================================================
@@ -159,20 +133,14 @@ void FirstCompressorAudioProcessor::prepareToPlay (double sampleRate, int sample
     
     juce::dsp::ProcessSpec spec;
     spec.maximumBlockSize=samplesPerBlock;
-    spec.numChannels=getTotalNumOutputChannels();
+    spec.numChannels=getMainBusNumOutputChannels();
     spec.sampleRate=sampleRate;
     
     for (auto& comp:compressors){
         comp.prepare(spec);
     }
     
-    LP1.prepare(spec);
-    HP1.prepare(spec);
-    
-    AP2.prepare(spec);
-    
-    LP2.prepare(spec);
-    HP2.prepare(spec);
+    crossover.prepare(spec);
     
     inputGain.prepare(spec);
     outputGain.prepare(spec);
@@ -180,10 +148,6 @@ void FirstCompressorAudioProcessor::prepareToPlay (double sampleRate, int sample
     inputGain.setRampDurationSeconds(0.05);
     outputGain.setRampDurationSeconds(0.05);
     
-    for (auto buffer:filterBuffers){
-        buffer.setSize(spec.numChannels, samplesPerBlock);
-    }
-    
 }
 
 void FirstCompressorAudioProcessor::releaseResources()
@@ -212,6 +176,13 @@ bool FirstCompressorAudioProcessor::isBusesLayoutSupported (const BusesLayout& l
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
    #endif
+    
+    // Band outputs are optional, but when enabled they carry the same channels as the main output.
+    for (auto i=1;i<layouts.outputBuses.size();++i){
+        const auto& bandSet=layouts.outputBuses.getReference(i);
+        if (! bandSet.isDisabled() && bandSet!=layouts.getMainOutputChannelSet())
+            return false;
+    }
 
     return true;
   #endif
@@ -236,7 +207,9 @@ void FirstCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>& buff
     inputGain.setGainDecibels(inputGainParam->get());
     outputGain.setGainDecibels(outputGainParam->get());
     
-    applyGain(buffer,inputGain);
+    auto mainBlock=getOutputBusBlock(buffer, 0);
+    
+    applyGain(mainBlock,inputGain);
     
 //    compressor.updateCompressorSettings();
 //    compressor.process(buffer);
@@ -244,50 +217,69 @@ void FirstCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>& buff
         compressor.updateCompressorSettings();
     }
     
-    for (auto& fb:filterBuffers){
-        fb=buffer;
+    crossover.setCrossovers(lowMidCrossover->get(), midHighCrossover->get());
+    
+    std::array<juce::dsp::AudioBlock<float>,3> bandOutputs;
+    for (size_t i=0;i<bandOutputs.size();++i){
+        bandOutputs[i]=getOutputBusBlock(buffer, static_cast<int>(i)+1);
     }
     
-    // FIND A WAY TO D-R-Y THIS OUT
-    auto lowMidCutoffFreq=lowMidCrossover->get();
-    LP1.setCutoffFrequency(lowMidCutoffFreq);
-    HP1.setCutoffFrequency(lowMidCutoffFreq);
+    // Work through the block in chunks that fit the fixed band scratch, whatever block size
+    // the host sends (some send more samples than they announced in prepareToPlay).
+    auto chunkSize=ScratchBuffers::maxSamples;
+    auto numSamples=mainBlock.getNumSamples();
+    for (size_t start=0;start<numSamples;start+=chunkSize){
+        auto length=juce::jmin(chunkSize, numSamples-start);
+        
+        std::array<juce::dsp::AudioBlock<float>,3> bandChunks;
+        for (size_t i=0;i<bandOutputs.size();++i){
+            if (bandOutputs[i].getNumChannels()>0){
+                bandChunks[i]=bandOutputs[i].getSubBlock(start, length);
+            }
+        }
+        
+        processBands(mainBlock.getSubBlock(start, length), bandChunks);
+    }
     
-    auto midHighCutoffFreq=midHighCrossover->get();
-    AP2.setCutoffFrequency(midHighCutoffFreq);
-    LP2.setCutoffFrequency(midHighCutoffFreq);
-    HP2.setCutoffFrequency(midHighCutoffFreq);
+    applyGain(mainBlock, outputGain);
     
     
-    auto fb0block=juce::dsp::AudioBlock<float>(filterBuffers[0]);
-    auto fb1block=juce::dsp::AudioBlock<float>(filterBuffers[1]);
-    auto fb2block=juce::dsp::AudioBlock<float>(filterBuffers[2]);
+}
+
+juce::dsp::AudioBlock<float> FirstCompressorAudioProcessor::getOutputBusBlock(juce::AudioBuffer<float>& buffer, int busIndex)
+{
+    // Points straight at the bus's channels in the host buffer; nothing is copied.
+    auto* bus=getBus(false, busIndex);
+    if (bus==nullptr || ! bus->isEnabled()){
+        return {};
+    }
     
-    auto fb0ctx=juce::dsp::ProcessContextReplacing<float>(fb0block);
-    auto fb1ctx=juce::dsp::ProcessContextReplacing<float>(fb1block);
-    auto fb2ctx=juce::dsp::ProcessContextReplacing<float>(fb2block);
+    return juce::dsp::AudioBlock<float>(buffer.getArrayOfWritePointers()+bus->getChannelIndexInProcessBlockBuffer(0),
+                                        static_cast<size_t>(bus->getNumberOfChannels()),
+                                        static_cast<size_t>(buffer.getNumSamples()));
+}
+
+void FirstCompressorAudioProcessor::processBands(juce::dsp::AudioBlock<float> block, const std::array<juce::dsp::AudioBlock<float>,3>& bandOutputs)
+{
+    auto numChannels=block.getNumChannels();
+    auto numSamples=block.getNumSamples();
     
-    LP1.process(fb0ctx);
-    AP2.process(fb0ctx);
-    HP1.process(fb1ctx);
-    filterBuffers[2]=filterBuffers[1];
-    LP2.process(fb1ctx);
-    HP2.process(fb2ctx);
+    // A band routed to its own output bus is split and compressed right there in the host
+    // buffer. Otherwise the low and mid bands use the scratch, and the high band is split
+    // in place in the main block, which is also where the bands are summed.
+    auto isRouted=[&bandOutputs](size_t band){ return bandOutputs[band].getNumChannels()>0; };
     
-    for (size_t i=0;i<compressors.size();++i){
-        compressors[i].process(filterBuffers[i]);
-    }
+    auto lowBand=isRouted(0) ? bandOutputs[0] : scratch.getBand(0, numChannels, numSamples);
+    auto midBand=isRouted(1) ? bandOutputs[1] : scratch.getBand(1, numChannels, numSamples);
+    auto highBand=isRouted(2) ? bandOutputs[2] : block;
     
-    auto numSamples=buffer.getNumSamples();
-    auto numChannels=buffer.getNumChannels();
+    crossover.process(block, lowBand, midBand, highBand);
     
-    buffer.clear();
+    std::array<juce::dsp::AudioBlock<float>,3> bandBlocks { lowBand, midBand, highBand };
     
-    auto addFilterBand=[nc=numChannels,ns=numSamples](auto& inputBuffer,const auto& source){
-        for (auto i=0;i<nc;++i){
-            inputBuffer.addFrom(i, 0, source, i, 0, ns);
-        }
-    };
+    for (size_t i=0;i<compressors.size();++i){
+        compressors[i].process(bandBlocks[i]);
+    }
     
     auto bandsAreSoloed=false;
     for (auto& comp:compressors){
@@ -297,30 +289,22 @@ void FirstCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>& buff
         }
     }
     
+    auto bandIsAudible=[bandsAreSoloed](const CompressorBand& comp){
+        return bandsAreSoloed ? comp.solo->get() : ! comp.mute->get();
+    };
     
-//    addFilterBand(buffer, filterBuffers[0]);
-//    addFilterBand(buffer, filterBuffers[1]);
-//    addFilterBand(buffer, filterBuffers[2]);
-    if (bandsAreSoloed){
-        for (size_t i=0;i<compressors.size();i++){
-            auto& comp=compressors[i];
-            if (comp.solo->get()){
-                addFilterBand(buffer, filterBuffers[i]);
-            }
-        }
+    // Solo and mute only shape the main mix; band outputs always carry their band.
+    auto highIsInMain=! isRouted(2);
+    if (! (highIsInMain && bandIsAudible(compressors[2]))){
+        block.clear();
     }
-    else{
-        for (size_t i=0;i<compressors.size();i++){
-            auto& comp=compressors[i];
-            if (! comp.mute->get()){
-                addFilterBand(buffer, filterBuffers[i]);
-            }
+    
+    for (size_t i=0;i<compressors.size();++i){
+        auto alreadyInMain=(i==2 && highIsInMain);
+        if (! alreadyInMain && bandIsAudible(compressors[i])){
+            block.add(bandBlocks[i]);
         }
     }
-    
-    applyGain(buffer, outputGain);
-    
-    
 }
 
 //==============================================================================
@@ -331,7 +315,7 @@ bool FirstCompressorAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* FirstCompressorAudioProcessor::createEditor()
 {
-    return new juce::GenericAudioProcessorEditor (*this);
+    return new FirstCompressorAudioProcessorEditor (*this);
 }
 
 //==============================================================================
@@ -356,124 +340,96 @@ void FirstCompressorAudioProcessor::setStateInformation (const void* data, int s
     }
 }
 
-juce::AudioProcessorValueTreeState::ParameterLayout FirstCompressorAudioProcessor::createParameterLayout(){
+juce::AudioProcessorValueTreeState::ParameterLayout FirstCompressorAudioProcessor::createParameterLayout(Params::Bindings& bindings, const Params::SharedTables& tables){
     APVTS::ParameterLayout layout;
     
     using namespace juce;
     using namespace Params;
-    const auto& params=GetParams();
-    
-    auto gainRange=NormalisableRange<float>(-24.f, 24.f, .5f, 1.f);
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Gain_In), 5 },
-                                                     params.at(Names::Gain_In),
-                                                     gainRange,
-                                                     0));
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Gain_Out), 5 },
-                                                     params.at(Names::Gain_Out),
-                                                     gainRange,
-                                                     0));
-    
-    // CHANGE AND OPTIMIZE ALL OF THIS
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Threshold_Low_Band), 3 },
-                                                     params.at(Names::Threshold_Low_Band),
-                                                     NormalisableRange<float>(-60, 12, 1, 1),
-                                                     0));
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Threshold_Mid_Band), 3 },
-                                                     params.at(Names::Threshold_Mid_Band),
-                                                     NormalisableRange<float>(-60, 12, 1, 1),
-                                                     0));
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Threshold_High_Band), 3 },
-                                                     params.at(Names::Threshold_High_Band),
-                                                     NormalisableRange<float>(-60, 12, 1, 1),
-                                                     0));
-    
-    auto attackReleaseRange=NormalisableRange<float>(5, 500, 1, 1);
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Attack_Low_Band) , 3 },
-                                                     params.at(Names::Attack_Low_Band),
-                                                     attackReleaseRange,
-                                                     50));
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Attack_Mid_Band) , 3 },
-                                                     params.at(Names::Attack_Mid_Band),
-                                                     attackReleaseRange,
-                                                     50));
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Attack_High_Band) , 3 },
-                                                     params.at(Names::Attack_High_Band),
-                                                     attackReleaseRange,
-                                                     50));
-    
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Release_Low_Band), 3 },
-                                                     params.at(Names::Release_Low_Band),
-                                                     attackReleaseRange,
-                                                     250));
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Release_Mid_Band), 3 },
-                                                     params.at(Names::Release_Mid_Band),
-                                                     attackReleaseRange,
-                                                     250));
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID { params.at(Names::Release_High_Band), 3 },
-                                                     params.at(Names::Release_High_Band),
-                                                     attackReleaseRange,
-                                                     250));
-    
-    auto choices=std::vector<double>{1,1.5,2,3,4,5,6,7,8,10,15,20,50,100};
-    juce::StringArray sa;
-    for (auto choice:choices){
-        sa.add(juce::String(choice,1));
+    
+    // Everything comes from Params::Schema; each parameter is bound as it is created, so
+    // the constructor never has to search the APVTS or cast what it gets back.
+    for (const auto& spec:Schema){
+        auto id=ParameterID { spec.id, spec.version };
+        std::unique_ptr<RangedAudioParameter> param;
+        
+        switch (spec.kind){
+            case Kind::Float:
+                param=std::make_unique<AudioParameterFloat>(id,
+                                                            spec.id,
+                                                            NormalisableRange<float>(spec.start, spec.end, spec.interval, spec.skew),
+                                                            spec.defaultValue);
+                break;
+            case Kind::Choice:
+                param=std::make_unique<AudioParameterChoice>(id,
+                                                             spec.id,
+                                                             tables.ratioNames,
+                                                             static_cast<int>(spec.defaultValue));
+                break;
+            case Kind::Bool:
+                param=std::make_unique<AudioParameterBool>(id,
+                                                           spec.id,
+                                                           spec.defaultValue!=0);
+                break;
+        }
+        
+        bindings.params[spec.name]=param.get();
+        layout.add(std::move(param));
     }
     
+    return layout;
+}
+
+void FirstCompressorAudioProcessor::startAutoConfigure(const juce::File& file, const AutoConfig::Target& target)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
     
-    layout.add(std::make_unique<AudioParameterChoice>(ParameterID { params.at(Names::Ratio_Low_Band), 3 },
-                                                      params.at(Names::Ratio_Low_Band),
-                                                      sa,
-                                                      3));
-    layout.add(std::make_unique<AudioParameterChoice>(ParameterID { params.at(Names::Ratio_Mid_Band), 3 },
-                                                      params.at(Names::Ratio_Mid_Band),
-                                                      sa,
-                                                      3));
-    layout.add(std::make_unique<AudioParameterChoice>(ParameterID { params.at(Names::Ratio_High_Band), 3 },
-                                                      params.at(Names::Ratio_High_Band),
-                                                      sa,
-                                                      3));
-    
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Bypassed_Low_Band),3},
-                                                    params.at(Names::Bypassed_Low_Band),
-                                                    false));
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Bypassed_Mid_Band),3},
-                                                    params.at(Names::Bypassed_Mid_Band),
-                                                    false));
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Bypassed_High_Band),3},
-                                                    params.at(Names::Bypassed_High_Band),
-                                                    false));
-    
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Mute_Low_Band),4},
-                                                    params.at(Names::Mute_Low_Band),
-                                                    false));
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Mute_Mid_Band),4},
-                                                    params.at(Names::Mute_Mid_Band),
-                                                    false));
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Mute_High_Band),4},
-                                                    params.at(Names::Mute_High_Band),
-                                                    false));
-    
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Solo_Low_Band),4},
-                                                    params.at(Names::Solo_Low_Band),
-                                                    false));
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Solo_Mid_Band),4},
-                                                    params.at(Names::Solo_Mid_Band),
-                                                    false));
-    layout.add(std::make_unique<AudioParameterBool>(ParameterID{params.at(Names::Solo_High_Band),4},
-                                                    params.at(Names::Solo_High_Band),
-                                                    false));
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID{params.at(Names::Low_Mid_Crossover_Freq),3}, params.at(Names::Low_Mid_Crossover_Freq), NormalisableRange<float>(20, 999, 1, 1), 400));
-    
-    layout.add(std::make_unique<AudioParameterFloat>(ParameterID{params.at(Names::Mid_High_Crossover_Freq),3}, params.at(Names::Mid_High_Crossover_Freq), NormalisableRange<float>(1000, 20000, 1, 1), 2000));
+    if (isAutoConfiguring()){
+        return;
+    }
     
-    return layout;
+    autoConfigCancelled=false;
+    juce::WeakReference<FirstCompressorAudioProcessor> weakThis(this);
+    
+    autoConfigTask=std::async(std::launch::async, [this, weakThis, file, target]{
+        auto proposal=AutoConfig::analyse(file, target, &autoConfigCancelled);
+        if (! proposal.has_value()){
+            return;
+        }
+        
+        // The processor may be gone by the time the message thread gets to this.
+        juce::MessageManager::callAsync([weakThis, proposal=*proposal]{
+            if (auto* processor=weakThis.get()){
+                processor->applyProposal(proposal);
+            }
+        });
+    });
+}
+
+bool FirstCompressorAudioProcessor::isAutoConfiguring() const
+{
+    return autoConfigTask.valid()
+        && autoConfigTask.wait_for(std::chrono::seconds(0))!=std::future_status::ready;
+}
+
+void FirstCompressorAudioProcessor::applyProposal(const AutoConfig::Proposal& proposal)
+{
+    // Each change is its own gesture so hosts record it like a user edit.
+    auto set=[](auto* param, auto value){
+        param->beginChangeGesture();
+        *param=value;
+        param->endChangeGesture();
+    };
+    
+    set(lowMidCrossover, proposal.lowMidCrossover);
+    set(midHighCrossover, proposal.midHighCrossover);
+    
+    // The proposal measured the file as read, but the compressors see it after the input gain.
+    auto inputGainDb=inputGainParam->get();
+    
+    for (size_t i=0;i<compressors.size();++i){
+        set(compressors[i].threshold, proposal.thresholds[i]+inputGainDb);
+        set(compressors[i].ratio, proposal.ratioIndices[i]);
+    }
 }
 
 //==============================================================================
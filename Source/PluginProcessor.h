@@ -21,6 +21,9 @@ DSP Roadmap:
  */
 
 #include <JuceHeader.h>
+#include <future>
+#include "AutoConfig.h"
+#include "Crossover.h"
 
 //==============================================================================
 /**
@@ -65,41 +68,151 @@ enum Names
     Gain_Out,
 };
 
-inline const std::map<Names,juce::String>& GetParams(){
-    static std::map<Names,juce::String> Params=
+constexpr size_t NumParams=Gain_Out+1;
+
+enum class Kind
+{
+    Float,
+    Choice,
+    Bool,
+};
+
+// One entry per parameter. The name doubles as the ParameterID, so it must never change
+// once a build has shipped (saved sessions and automation are keyed on it).
+struct Spec
+{
+    Names name;
+    const char* id;
+    int version;
+    Kind kind;
+    float start {0}, end {1}, interval {0}, skew {1};
+    float defaultValue {0};   // Choice: index into RatioChoices, Bool: 0 or 1
+};
+
+inline constexpr std::array<float,14> RatioChoices { 1.f, 1.5f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 10.f, 15.f, 20.f, 50.f, 100.f };
+
+// Listed in the order the parameters are added to the layout (hosts index automation by it).
+inline constexpr std::array<Spec,NumParams> Schema
+{{
+    {Gain_In,                 "Gain In",                 5, Kind::Float,  -24, 24, .5f, 1, 0},
+    {Gain_Out,                "Gain Out",                5, Kind::Float,  -24, 24, .5f, 1, 0},
+
+    {Threshold_Low_Band,      "Threshold Low Band",      3, Kind::Float,  -60, 12, 1, 1, 0},
+    {Threshold_Mid_Band,      "Threshold Mid Band",      3, Kind::Float,  -60, 12, 1, 1, 0},
+    {Threshold_High_Band,     "Threshold High Band",     3, Kind::Float,  -60, 12, 1, 1, 0},
+
+    {Attack_Low_Band,         "Attack Low Band",         3, Kind::Float,  5, 500, 1, 1, 50},
+    {Attack_Mid_Band,         "Attack Mid Band",         3, Kind::Float,  5, 500, 1, 1, 50},
+    {Attack_High_Band,        "Attack High Band",        3, Kind::Float,  5, 500, 1, 1, 50},
+
+    {Release_Low_Band,        "Release Low Band",        3, Kind::Float,  5, 500, 1, 1, 250},
+    {Release_Mid_Band,        "Release Mid Band",        3, Kind::Float,  5, 500, 1, 1, 250},
+    {Release_High_Band,       "Release High Band",       3, Kind::Float,  5, 500, 1, 1, 250},
+
+    {Ratio_Low_Band,          "Ratio Low Band",          3, Kind::Choice, 0, 0, 0, 1, 3},
+    {Ratio_Mid_Band,          "Ratio Mid Band",          3, Kind::Choice, 0, 0, 0, 1, 3},
+    {Ratio_High_Band,         "Ratio High Band",         3, Kind::Choice, 0, 0, 0, 1, 3},
+
+    {Bypassed_Low_Band,       "Bypassed Low Band",       3, Kind::Bool},
+    {Bypassed_Mid_Band,       "Bypassed Mid Band",       3, Kind::Bool},
+    {Bypassed_High_Band,      "Bypassed High Band",      3, Kind::Bool},
+
+    {Mute_Low_Band,           "Mute Low Band",           4, Kind::Bool},
+    {Mute_Mid_Band,           "Mute Mid Band",           4, Kind::Bool},
+    {Mute_High_Band,          "Mute High Band",          4, Kind::Bool},
+
+    {Solo_Low_Band,           "Solo Low Band",           4, Kind::Bool},
+    {Solo_Mid_Band,           "Solo Mid Band",           4, Kind::Bool},
+    {Solo_High_Band,          "Solo High Band",          4, Kind::Bool},
+
+    {Low_Mid_Crossover_Freq,  "Low-Mid Crossover Freq",  3, Kind::Float,  20, 999, 1, 1, 400},
+    {Mid_High_Crossover_Freq, "Mid-High Crossover Freq", 3, Kind::Float,  1000, 20000, 1, 1, 2000},
+}};
+
+constexpr bool schemaCoversEveryName()
+{
+    for (size_t n=0;n<NumParams;++n){
+        auto count=0;
+        for (const auto& spec:Schema){
+            if (spec.name==static_cast<Names>(n)){
+                ++count;
+            }
+        }
+        if (count!=1){
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(schemaCoversEveryName(), "Every Params::Names entry needs exactly one Schema entry");
+
+// Position of each name's entry in Schema, worked out at compile time.
+constexpr std::array<size_t,NumParams> makeSchemaIndex()
+{
+    std::array<size_t,NumParams> index {};
+    for (size_t i=0;i<NumParams;++i){
+        index[Schema[i].name]=i;
+    }
+    return index;
+}
+
+inline constexpr auto SchemaIndex=makeSchemaIndex();
+
+constexpr const Spec& specFor(Names name)
+{
+    return Schema[SchemaIndex[name]];
+}
+
+template<Kind K> struct ParameterType;
+template<> struct ParameterType<Kind::Float>  { using type=juce::AudioParameterFloat; };
+template<> struct ParameterType<Kind::Choice> { using type=juce::AudioParameterChoice; };
+template<> struct ParameterType<Kind::Bool>   { using type=juce::AudioParameterBool; };
+
+// Read-only data every instance needs. Held through a juce::SharedResourcePointer so one
+// copy exists per process while any instance is alive.
+struct SharedTables
+{
+    SharedTables()
     {
-        {Low_Mid_Crossover_Freq,"Low-Mid Crossover Freq"},
-        {Mid_High_Crossover_Freq,"Mid-High Crossover Freq"},
-        {Threshold_Low_Band,"Threshold Low Band"},
-        {Threshold_Mid_Band,"Threshold Mid Band"},
-        {Threshold_High_Band,"Threshold High Band"},
-        {Attack_Low_Band,"Attack Low Band"},
-        {Attack_Mid_Band,"Attack Mid Band"},
-        {Attack_High_Band,"Attack High Band"},
-        {Release_Low_Band,"Release Low Band"},
-        {Release_Mid_Band,"Release Mid Band"},
-        {Release_High_Band,"Release High Band"},
-        {Ratio_Low_Band,"Ratio Low Band"},
-        {Ratio_Mid_Band,"Ratio Mid Band"},
-        {Ratio_High_Band,"Ratio High Band"},
-        {Bypassed_Low_Band,"Bypassed Low Band"},
-        {Bypassed_Mid_Band,"Bypassed Mid Band"},
-        {Bypassed_High_Band,"Bypassed High Band"},
-        {Mute_Low_Band,"Mute Low Band"},
-        {Mute_Mid_Band,"Mute Mid Band"},
-        {Mute_High_Band,"Mute High Band"},
-        {Solo_Low_Band,"Solo Low Band"},
-        {Solo_Mid_Band,"Solo Mid Band"},
-        {Solo_High_Band,"Solo High Band"},
-        {Gain_In,"Gain In"},
-        {Gain_Out,"Gain Out"},
+        for (auto choice:RatioChoices){
+            ratioNames.add(juce::String(choice,1));
+        }
     }
-    ;
-    
     
+    // juce::String is reference counted, so every AudioParameterChoice built from this
+    // shares the same text instead of owning its own.
+    juce::StringArray ratioNames;
+};
+
+// The parameter names belonging to each compressor band, low to high.
+struct BandNames
+{
+    Names attack, release, threshold, ratio, bypassed, mute, solo;
+};
+
+inline constexpr std::array<BandNames,3> Bands
+{{
+    {Attack_Low_Band,  Release_Low_Band,  Threshold_Low_Band,  Ratio_Low_Band,  Bypassed_Low_Band,  Mute_Low_Band,  Solo_Low_Band},
+    {Attack_Mid_Band,  Release_Mid_Band,  Threshold_Mid_Band,  Ratio_Mid_Band,  Bypassed_Mid_Band,  Mute_Mid_Band,  Solo_Mid_Band},
+    {Attack_High_Band, Release_High_Band, Threshold_High_Band, Ratio_High_Band, Bypassed_High_Band, Mute_High_Band, Solo_High_Band},
+}};
+
+// Filled in by createParameterLayout as each parameter is created, so the processor can
+// pick up typed pointers without looking anything up in the APVTS afterwards.
+struct Bindings
+{
+    // The pointer type comes from the name's Schema entry at compile time, so binding a
+    // parameter to a member of the wrong kind doesn't compile.
+    template<Names N>
+    auto* get() const
+    {
+        using Parameter=typename ParameterType<specFor(N).kind>::type;
+        return static_cast<Parameter*>(params[N]);
+    }
     
-    return Params;
-}
+    std::array<juce::RangedAudioParameter*,NumParams> params {};
+};
 }
 
 struct CompressorBand
@@ -120,11 +233,10 @@ struct CompressorBand
         compressor.setAttack(attack->get());
         compressor.setRelease(release->get());
         compressor.setThreshold(threshold->get());
-        compressor.setRatio(ratio->getCurrentChoiceName().getFloatValue());
+        compressor.setRatio(Params::RatioChoices[static_cast<size_t>(ratio->getIndex())]);
     }
     
-    void process(juce::AudioBuffer<float>& buffer){
-        auto block=juce::dsp::AudioBlock<float>(buffer);
+    void process(juce::dsp::AudioBlock<float> block){
         auto context=juce::dsp::ProcessContextReplacing<float>(block);
         
         context.isBypassed=bypassed->get();
@@ -182,31 +294,66 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     
     using APVTS=juce::AudioProcessorValueTreeState;
-    static APVTS::ParameterLayout createParameterLayout();
+    static APVTS::ParameterLayout createParameterLayout(Params::Bindings& bindings, const Params::SharedTables& tables);
+    
+private:
+    // Both must be declared before apvts, which uses them during construction.
+    juce::SharedResourcePointer<Params::SharedTables> sharedTables;
+    Params::Bindings paramBindings;
+    
+public:
+    APVTS apvts{ *this, nullptr, "Parameters", createParameterLayout(paramBindings, *sharedTables) };
+    
+    // Analyses an audio file on a background task, then applies the proposed settings as a
+    // preset on the message thread. Call from the message thread; does nothing while an
+    // analysis is already running.
+    void startAutoConfigure(const juce::File& file, const AutoConfig::Target& target={});
+    bool isAutoConfiguring() const;
     
-    APVTS apvts{ *this, nullptr, "Parameters", createParameterLayout() };
+    void applyProposal(const AutoConfig::Proposal& proposal);
 
 private:
    
     
     std::array<CompressorBand,3> compressors;
-    CompressorBand& lowBandComp=compressors[0];
-    CompressorBand& midBandComp=compressors[1];
-    CompressorBand& highBandComp=compressors[2];
     
 
-    using Filter=juce::dsp::LinkwitzRileyFilter<float>;
-    //     FC0  FC1
-    Filter LP1, AP2,
-           HP1, LP2,
-                HP2;
+    ThreeBandCrossover<float> crossover;
     
     
     
     juce::AudioParameterFloat* lowMidCrossover {nullptr};
     juce::AudioParameterFloat* midHighCrossover {nullptr};
     
-    std::array<juce::AudioBuffer<float>, 3> filterBuffers;
+    // Band scratch for processBlock. The high band is split in place in the host buffer, so
+    // only the low and mid bands need it: 8 KiB, held inline by each instance. It isn't a
+    // thread_local because a plugin binary is loaded with dlopen, where thread-local storage
+    // is allocated lazily the first time each thread touches it, i.e. inside processBlock.
+    // processBlock works through blocks in chunks of at most maxSamples.
+    struct ScratchBuffers
+    {
+        static constexpr size_t maxChannels=2;   // isBusesLayoutSupported allows mono or stereo
+        static constexpr size_t maxSamples=512;
+        
+        juce::dsp::AudioBlock<float> getBand(size_t index, size_t numChannels, size_t numSamples){
+            jassert(numChannels<=maxChannels && numSamples<=maxSamples);
+            for (size_t ch=0;ch<numChannels;++ch){
+                channels[index][ch]=samples[index][ch];
+            }
+            return juce::dsp::AudioBlock<float>(channels[index], numChannels, numSamples);
+        }
+        
+        float samples[2][maxChannels][maxSamples];
+        float* channels[2][maxChannels];
+    };
+    
+    ScratchBuffers scratch;
+    
+    // Empty when the bus is disabled or missing.
+    juce::dsp::AudioBlock<float> getOutputBusBlock(juce::AudioBuffer<float>& buffer, int busIndex);
+    
+    // bandOutputs holds the enabled per-band output buses (empty blocks for the rest).
+    void processBands(juce::dsp::AudioBlock<float> block, const std::array<juce::dsp::AudioBlock<float>,3>& bandOutputs);
     
     juce::dsp::Gain<float> inputGain,outputGain;
     juce::AudioParameterFloat* inputGainParam {nullptr};
@@ -220,7 +367,11 @@ private:
         gain.process(context);
     }
     
+    std::future<void> autoConfigTask;
+    std::atomic<bool> autoConfigCancelled {false};
+    
     //==============================================================================
+    JUCE_DECLARE_WEAK_REFERENCEABLE (FirstCompressorAudioProcessor)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FirstCompressorAudioProcessor)
     
 };
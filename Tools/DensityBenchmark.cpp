@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Loads N instances of FirstCompressorAudioProcessor the way a busy session
+    would and reports what they cost together: resident memory per instance,
+    and the CPU needed to run all of them on one audio thread.
+
+    Usage: DensityBenchmark [numInstances] [secondsOfAudio] [sampleRate] [blockSize]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#if JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+namespace
+{
+// Resident set size of this process in bytes, or -1 where the platform isn't supported.
+juce::int64 residentBytes()
+{
+   #if JUCE_LINUX
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)){
+        if (line.rfind("VmRSS:", 0)==0){
+            return juce::String(line).fromFirstOccurrenceOf(":", false, false).getLargeIntValue()*1024;
+        }
+    }
+    return -1;
+   #elif JUCE_MAC
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count=TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, reinterpret_cast<task_info_t>(&info), &count)!=KERN_SUCCESS){
+        return -1;
+    }
+    return static_cast<juce::int64>(info.phys_footprint);
+   #else
+    return -1;
+   #endif
+}
+
+void reportMemory(const char* label, juce::int64 before, juce::int64 after, int numInstances)
+{
+    if (before<0 || after<0){
+        std::cout << label << "  not measured on this platform\n";
+        return;
+    }
+
+    auto delta=static_cast<double>(after-before);
+    std::cout << label << "  " << delta/(1024.0*1024.0) << " MiB total, "
+              << delta/1024.0/numInstances << " KiB per instance\n";
+}
+}
+
+int main(int argc, char* argv[])
+{
+    // The APVTS starts a timer when it is constructed, which needs a message manager.
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    auto numInstances=argc>1 ? juce::jmax(1, juce::String(argv[1]).getIntValue()) : 300;
+    auto seconds=argc>2 ? juce::String(argv[2]).getDoubleValue() : 10.0;
+    auto sampleRate=argc>3 ? juce::String(argv[3]).getDoubleValue() : 48000.0;
+    auto blockSize=argc>4 ? juce::jmax(1, juce::String(argv[4]).getIntValue()) : 256;
+
+    std::vector<std::unique_ptr<FirstCompressorAudioProcessor>> instances;
+    instances.reserve(static_cast<size_t>(numInstances));
+
+    auto baseline=residentBytes();
+    for (auto i=0;i<numInstances;++i){
+        instances.push_back(std::make_unique<FirstCompressorAudioProcessor>());
+    }
+    auto constructed=residentBytes();
+
+    for (auto& instance:instances){
+        instance->prepareToPlay(sampleRate, blockSize);
+    }
+    auto prepared=residentBytes();
+
+    juce::AudioBuffer<float> input(2, blockSize), work(2, blockSize);
+    juce::Random random(1234);
+    juce::MidiBuffer midi;
+
+    auto numBlocks=juce::jmax(1, static_cast<int>(seconds*sampleRate/blockSize));
+    double processingSeconds=0;
+
+    for (auto block=0;block<numBlocks;++block){
+        for (auto ch=0;ch<input.getNumChannels();++ch){
+            for (auto i=0;i<blockSize;++i){
+                input.setSample(ch, i, random.nextFloat()*.5f-.25f);
+            }
+        }
+
+        for (auto& instance:instances){
+            work.makeCopyOf(input, true);
+
+            auto start=std::chrono::steady_clock::now();
+            instance->processBlock(work, midi);
+            processingSeconds+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        }
+    }
+    auto afterProcessing=residentBytes();
+
+    auto audioSeconds=numBlocks*static_cast<double>(blockSize)/sampleRate;
+
+    std::cout << numInstances << " instances, " << sampleRate << " Hz, " << blockSize << " samples per block\n";
+    reportMemory("memory after construct      ", baseline, constructed, numInstances);
+    reportMemory("memory after prepareToPlay  ", baseline, prepared, numInstances);
+    reportMemory("memory after processing     ", baseline, afterProcessing, numInstances);
+    std::cout << "cpu  " << audioSeconds << " s of audio in " << processingSeconds << " s on one thread = "
+              << 100.0*processingSeconds/audioSeconds << "% of one core, "
+              << 100.0*processingSeconds/audioSeconds/numInstances << "% per instance\n";
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    Measures what a host pays per instance at project load: constructing
+    FirstCompressorAudioProcessor, then its first prepareToPlay.
+
+    Usage: StartupBenchmark [numInstances] [sampleRate] [blockSize]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+using Clock=std::chrono::steady_clock;
+
+double microsecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now()-start).count();
+}
+
+void report(const char* label, std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    auto total=std::accumulate(times.begin(), times.end(), 0.0);
+
+    std::cout << label
+              << "  mean " << total/static_cast<double>(times.size()) << " us"
+              << "  median " << times[times.size()/2] << " us"
+              << "  max " << times.back() << " us"
+              << "  total " << total/1000.0 << " ms\n";
+}
+}
+
+int main(int argc, char* argv[])
+{
+    // The APVTS starts a timer when it is constructed, which needs a message manager.
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    auto numInstances=argc>1 ? juce::jmax(1, juce::String(argv[1]).getIntValue()) : 300;
+    auto sampleRate=argc>2 ? juce::String(argv[2]).getDoubleValue() : 48000.0;
+    auto blockSize=argc>3 ? juce::jmax(1, juce::String(argv[3]).getIntValue()) : 512;
+
+    std::vector<std::unique_ptr<FirstCompressorAudioProcessor>> instances;
+    instances.reserve(static_cast<size_t>(numInstances));
+
+    std::vector<double> constructTimes, prepareTimes, totalTimes;
+
+    for (auto i=0;i<numInstances;++i){
+        auto start=Clock::now();
+        instances.push_back(std::make_unique<FirstCompressorAudioProcessor>());
+        constructTimes.push_back(microsecondsSince(start));
+
+        auto prepareStart=Clock::now();
+        instances.back()->prepareToPlay(sampleRate, blockSize);
+        prepareTimes.push_back(microsecondsSince(prepareStart));
+
+        totalTimes.push_back(microsecondsSince(start));
+    }
+
+    std::cout << numInstances << " instances, " << sampleRate << " Hz, " << blockSize << " samples per block\n";
+    report("construct        ", constructTimes);
+    report("prepareToPlay    ", prepareTimes);
+    report("construct+prepare", totalTimes);
+
+    return 0;
+}
@@ -0,0 +1,318 @@
+/*
+  ==============================================================================
+
+    Drives FirstCompressorAudioProcessor the way an awkward host would:
+    random block sizes from 1 to 8192, re-prepares at random sample rates
+    and bus layouts (mono/stereo, band outputs on or off), live/offline
+    switches with and without a re-prepare, and a fresh random value for
+    every parameter in Params::Schema on every block, solo and mute included.
+    Blocks run in short bursts, each on a newly started thread, the way hosts
+    hand processing to different worker threads, so anything set up lazily
+    per thread shows up inside processBlock.
+
+    The processor is linked into this executable, so its thread-local storage
+    is static. Lazy thread-local allocation that only happens in a plugin
+    loaded with dlopen is not seen here.
+
+    Reports worst-case and p99.9 processBlock time, and fails (non-zero exit)
+    if any output sample is NaN, infinite or denormal, or if processBlock
+    allocates or takes a mutex.
+
+    Usage: StressHarness [numBlocks] [seed]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace
+{
+// Only set while processBlock runs on this thread; the hooks below count against it.
+thread_local bool insideAudioCallback=false;
+
+std::atomic<int> audioThreadAllocations {0};
+std::atomic<int> audioThreadLocks {0};
+
+void noteAllocation() noexcept
+{
+    if (insideAudioCallback){
+        ++audioThreadAllocations;
+    }
+}
+}
+
+#if JUCE_LINUX
+// On Linux the allocator and pthread_mutex_lock are interposed, which catches every heap
+// allocation (including juce::HeapBlock, which calls malloc directly) and every mutex,
+// whether it is a juce::CriticalSection or a std::mutex.
+extern "C"
+{
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+
+void* malloc(size_t size)
+{
+    noteAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    noteAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    noteAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    noteAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+    noteAllocation();
+    *result=__libc_memalign(alignment, size);
+    return *result!=nullptr ? 0 : ENOMEM;
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    using LockFunction=int (*)(pthread_mutex_t*);
+    static const auto realLock=reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+
+    if (insideAudioCallback){
+        ++audioThreadLocks;
+    }
+    return realLock(mutex);
+}
+}
+
+constexpr bool locksAreChecked=true;
+#else
+// Elsewhere only C++ allocations are caught, and locks are not checked.
+void* operator new(std::size_t size)
+{
+    noteAllocation();
+    if (auto* ptr=std::malloc(size==0 ? 1 : size)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept              { std::free(ptr); }
+void operator delete[](void* ptr) noexcept            { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept   { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+constexpr bool locksAreChecked=false;
+#endif
+
+namespace
+{
+constexpr int maxBlockSize=8192;
+constexpr int maxChannels=8;    // stereo main output plus three stereo band outputs
+
+constexpr std::array<double,6> sampleRates { 22050, 44100, 48000, 88200, 96000, 192000 };
+
+struct Failures
+{
+    juce::int64 nonFinite=0;
+    juce::int64 denormal=0;
+};
+
+void fillInput(juce::AudioBuffer<float>& buffer, juce::Random& random)
+{
+    // Everything from silence and denormal-sized tails to full-scale noise.
+    enum { noise, silence, tiny, loud, numKinds };
+    auto kind=random.nextInt(numKinds);
+    auto level=kind==tiny ? 1.0e-30f : kind==loud ? 4.f : random.nextFloat();
+
+    for (auto ch=0;ch<buffer.getNumChannels();++ch){
+        auto* data=buffer.getWritePointer(ch);
+        for (auto i=0;i<buffer.getNumSamples();++i){
+            data[i]=kind==silence ? 0.f : (random.nextFloat()*2.f-1.f)*level;
+        }
+    }
+}
+
+void checkOutput(const juce::AudioBuffer<float>& buffer, int numOutputChannels, Failures& failures)
+{
+    for (auto ch=0;ch<numOutputChannels;++ch){
+        const auto* data=buffer.getReadPointer(ch);
+        for (auto i=0;i<buffer.getNumSamples();++i){
+            if (! std::isfinite(data[i])){
+                ++failures.nonFinite;
+            }
+            else if (std::fpclassify(data[i])==FP_SUBNORMAL){
+                ++failures.denormal;
+            }
+        }
+    }
+}
+}
+
+int main(int argc, char* argv[])
+{
+    // The APVTS starts a timer when it is constructed, which needs a message manager.
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    auto numBlocks=argc>1 ? juce::jmax(1, juce::String(argv[1]).getIntValue()) : 20000;
+    auto seed=argc>2 ? juce::String(argv[2]).getLargeIntValue() : juce::Time::currentTimeMillis();
+    juce::Random random(seed);
+
+    FirstCompressorAudioProcessor processor;
+
+    std::vector<juce::RangedAudioParameter*> parameters;
+    for (const auto& spec:Params::Schema){
+        parameters.push_back(processor.apvts.getParameter(spec.id));
+        jassert(parameters.back()!=nullptr);
+    }
+
+    // Everything the loop needs is allocated up front, so only processBlock is measured.
+    juce::AudioBuffer<float> buffer(maxChannels, maxBlockSize);
+    juce::MidiBuffer midi;
+    std::vector<double> blockMicros, realtimeFractions;
+    blockMicros.reserve(static_cast<size_t>(numBlocks));
+    realtimeFractions.reserve(static_cast<size_t>(numBlocks));
+
+    double sampleRate=0;
+    auto numPrepares=0, numRealtimeSwitches=0, numAudioThreads=0;
+
+    auto reconfigure=[&]{
+        processor.releaseResources();
+
+        auto mainSet=random.nextBool() ? juce::AudioChannelSet::stereo() : juce::AudioChannelSet::mono();
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(mainSet);
+        layout.outputBuses.add(mainSet);
+        for (auto band=0;band<3;++band){
+            layout.outputBuses.add(random.nextBool() ? mainSet : juce::AudioChannelSet::disabled());
+        }
+        auto layoutAccepted=processor.setBusesLayout(layout);
+        jassert(layoutAccepted);
+        juce::ignoreUnused(layoutAccepted);
+
+        sampleRate=sampleRates[static_cast<size_t>(random.nextInt(static_cast<int>(sampleRates.size())))];
+        auto announcedBlockSize=1+random.nextInt(maxBlockSize);
+
+        processor.setNonRealtime(random.nextInt(10)==0);
+        processor.setRateAndBufferSizeDetails(sampleRate, announcedBlockSize);
+        processor.prepareToPlay(sampleRate, announcedBlockSize);
+        ++numPrepares;
+    };
+
+    reconfigure();
+    auto blocksUntilReconfigure=200+random.nextInt(1800);
+
+    Failures failures;
+
+    auto runBlock=[&]{
+        // Some hosts flip between live and offline without preparing again.
+        if (random.nextInt(500)==0){
+            processor.setNonRealtime(! processor.isNonRealtime());
+            ++numRealtimeSwitches;
+        }
+
+        for (auto* parameter:parameters){
+            parameter->setValue(random.nextFloat());
+        }
+
+        auto numSamples=1+random.nextInt(maxBlockSize);
+        auto numChannels=juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        fillInput(buffer, random);
+
+        insideAudioCallback=true;
+        auto start=std::chrono::steady_clock::now();
+        processor.processBlock(buffer, midi);
+        auto elapsed=std::chrono::steady_clock::now()-start;
+        insideAudioCallback=false;
+
+        auto micros=std::chrono::duration<double, std::micro>(elapsed).count();
+        blockMicros.push_back(micros);
+        realtimeFractions.push_back(micros/(1.0e6*numSamples/sampleRate));
+
+        checkOutput(buffer, processor.getTotalNumOutputChannels(), failures);
+    };
+
+    for (auto block=0;block<numBlocks;){
+        if (blocksUntilReconfigure==0){
+            reconfigure();
+            blocksUntilReconfigure=200+random.nextInt(1800);
+        }
+
+        // Each burst runs on a thread that has never called processBlock before. Only one
+        // runs at a time, as a host never calls processBlock concurrently.
+        auto burst=juce::jmin(1+random.nextInt(64), numBlocks-block, blocksUntilReconfigure);
+        std::thread audioThread([&runBlock, burst]{
+            for (auto i=0;i<burst;++i){
+                runBlock();
+            }
+        });
+        audioThread.join();
+
+        block+=burst;
+        blocksUntilReconfigure-=burst;
+        ++numAudioThreads;
+    }
+
+    processor.releaseResources();
+
+    auto percentile=[](std::vector<double> values, double p){
+        std::sort(values.begin(), values.end());
+        auto index=static_cast<size_t>(std::ceil(p*static_cast<double>(values.size())))-1;
+        return values[juce::jmin(index, values.size()-1)];
+    };
+
+    std::cout << numBlocks << " blocks on " << numAudioThreads << " threads, seed " << seed << ", "
+              << numPrepares << " prepares, " << numRealtimeSwitches << " live/offline switches without prepare\n"
+              << "block time        worst " << percentile(blockMicros, 1.0) << " us"
+              << "  p99.9 " << percentile(blockMicros, .999) << " us\n"
+              << "share of realtime worst " << percentile(realtimeFractions, 1.0)
+              << "  p99.9 " << percentile(realtimeFractions, .999) << "\n"
+              << "non-finite samples " << failures.nonFinite << "\n"
+              << "denormal samples   " << failures.denormal << "\n"
+              << "audio-thread heap allocations " << audioThreadAllocations.load() << "\n"
+              << "audio-thread mutex locks      " << (locksAreChecked ? juce::String(audioThreadLocks.load()) : juce::String("not checked on this platform")) << "\n";
+
+    auto passed=failures.nonFinite==0
+             && failures.denormal==0
+             && audioThreadAllocations.load()==0
+             && audioThreadLocks.load()==0;
+
+    std::cout << (passed ? "PASSED" : "FAILED") << "\n";
+    return passed ? 0 : 1;
+}